@@ -0,0 +1,291 @@
+#include "blockstore.hpp"
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+// Container layout (all integers little-endian):
+//   magic "\x89FTZ", u32 block count
+//   per block: u32 raw size, u32 stored size, u32 CRC-32 of raw bytes, payload
+// A block whose stored size equals its raw size is kept uncompressed.
+static const char MAGIC[4] = {'\x89', 'F', 'T', 'Z'};
+static const std::size_t BLOCK_HEADER_SIZE = 12;
+
+// Compressed blocks are a sequence of LZ77 tokens. Each token byte holds the
+// literal length in its high nibble and the match length minus 4 in its low
+// nibble, with 15 meaning that further length bytes follow (255 = continue).
+// The literals come next, then a 2-byte back-reference offset and the match,
+// except in the final token, which holds literals only.
+static const std::size_t MIN_MATCH = 4;
+static const int HASH_BITS = 12;
+
+static uint32_t crc32(const char* data, std::size_t size) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void put_u32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static uint32_t get_u32(const char* p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+static void put_length(std::string& out, std::size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+static void put_sequence(std::string& out, const char* literals, std::size_t literal_length, std::size_t offset, std::size_t match_length) {
+    std::size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    out.push_back(static_cast<char>((std::min<std::size_t>(literal_length, 15) << 4) | std::min<std::size_t>(match_code, 15)));
+    if (literal_length >= 15) {
+        put_length(out, literal_length - 15);
+    }
+    out.append(literals, literal_length);
+    if (match_length) {
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (match_code >= 15) {
+            put_length(out, match_code - 15);
+        }
+    }
+}
+
+// Reuses the caller's output and hash table buffers across blocks
+static void compress(const char* src, std::size_t size, std::string& out, std::vector<int>& table) {
+    out.clear();
+    table.assign(1 << HASH_BITS, -1);
+    std::size_t anchor = 0;
+    std::size_t i = 0;
+    while (i + MIN_MATCH <= size) {
+        uint32_t word;
+        std::memcpy(&word, src + i, sizeof(word));
+        uint32_t hash = (word * 2654435761u) >> (32 - HASH_BITS);
+        int candidate = table[hash];
+        table[hash] = static_cast<int>(i);
+        if (candidate < 0 || i - static_cast<std::size_t>(candidate) > 0xFFFF || std::memcmp(src + candidate, src + i, MIN_MATCH) != 0) {
+            ++i;
+            continue;
+        }
+        std::size_t length = MIN_MATCH;
+        while (i + length < size && src[candidate + length] == src[i + length]) {
+            ++length;
+        }
+        put_sequence(out, src + anchor, i - anchor, i - candidate, length);
+        i += length;
+        anchor = i;
+    }
+    if (anchor < size) {
+        put_sequence(out, src + anchor, size - anchor, 0, 0);
+    }
+}
+
+// Returns false instead of reading or writing out of bounds on malformed input
+static bool get_length(const char*& ip, const char* end, std::size_t& length) {
+    unsigned char b;
+    do {
+        if (ip == end) {
+            return false;
+        }
+        b = static_cast<unsigned char>(*ip++);
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+static bool decompress(const char* ip, std::size_t size, char* out, std::size_t capacity) {
+    const char* end = ip + size;
+    char* op = out;
+    char* out_end = out + capacity;
+    while (ip < end) {
+        unsigned char token = static_cast<unsigned char>(*ip++);
+        std::size_t literal_length = token >> 4;
+        if (literal_length == 15 && !get_length(ip, end, literal_length)) {
+            return false;
+        }
+        if (literal_length > static_cast<std::size_t>(end - ip) || literal_length > static_cast<std::size_t>(out_end - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == end) {
+            break;
+        }
+        if (end - ip < 2) {
+            return false;
+        }
+        std::size_t offset = static_cast<unsigned char>(ip[0]) | (static_cast<unsigned char>(ip[1]) << 8);
+        ip += 2;
+        std::size_t match_length = token & 15;
+        if (match_length == 15 && !get_length(ip, end, match_length)) {
+            return false;
+        }
+        match_length += MIN_MATCH;
+        if (offset == 0 || offset > static_cast<std::size_t>(op - out) || match_length > static_cast<std::size_t>(out_end - op)) {
+            return false;
+        }
+        // Byte-wise so that overlapping matches repeat correctly
+        for (const char* match = op - offset; match_length > 0; --match_length) {
+            *op++ = *match++;
+        }
+    }
+    return op == out_end;
+}
+
+bool blockstore::is_container(const std::string& data) {
+    return data.size() >= sizeof(MAGIC) && std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+blockstore::Encoder::Encoder(FILE* file, std::size_t payload_size)
+    : file(file), remaining(payload_size), block(), compressed(), table() {
+    std::string header(MAGIC, sizeof(MAGIC));
+    put_u32(header, (payload_size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    fwrite(header.data(), 1, header.size(), file);
+    block.reserve(std::min(BLOCK_SIZE, payload_size));
+}
+
+void blockstore::Encoder::write(const char* data, std::size_t size) {
+    size = std::min(size, remaining);
+    remaining -= size;
+    while (size > 0) {
+        std::size_t n = std::min(size, BLOCK_SIZE - block.size());
+        block.append(data, n);
+        data += n;
+        size -= n;
+        if (block.size() == BLOCK_SIZE) {
+            flush_block();
+        }
+    }
+}
+
+bool blockstore::Encoder::finish() {
+    if (!block.empty()) {
+        flush_block();
+    }
+    return remaining == 0;
+}
+
+void blockstore::Encoder::flush_block() {
+    compress(block.data(), block.size(), compressed, table);
+    bool store_raw = compressed.size() >= block.size();
+    std::string header;
+    put_u32(header, block.size());
+    put_u32(header, store_raw ? block.size() : compressed.size());
+    put_u32(header, crc32(block.data(), block.size()));
+    fwrite(header.data(), 1, header.size(), file);
+    const std::string& payload = store_raw ? block : compressed;
+    fwrite(payload.data(), 1, payload.size(), file);
+    block.clear();
+}
+
+std::string blockstore::decode(const std::string& data) {
+    struct Block {
+        std::size_t raw_size;
+        std::size_t stored_size;
+        uint32_t crc;
+        std::size_t input;
+        std::size_t output;
+    };
+    if (data.size() < sizeof(MAGIC) + 4 || !is_container(data)) {
+        throw std::invalid_argument("File is in invalid format: missing container header.");
+    }
+
+    // Index the blocks sequentially; only the headers are touched here
+    std::size_t count = get_u32(data.data() + sizeof(MAGIC));
+    std::vector<Block> blocks;
+    std::size_t pos = sizeof(MAGIC) + 4;
+    std::size_t total = 0;
+    for (std::size_t b = 0; b < count; ++b) {
+        std::string where = "block " + std::to_string(b + 1) + " of " + std::to_string(count);
+        if (data.size() - pos < BLOCK_HEADER_SIZE) {
+            throw std::invalid_argument("File is truncated: " + where + " is missing.");
+        }
+        Block block = {get_u32(&data[pos]), get_u32(&data[pos + 4]), get_u32(&data[pos + 8]), pos + BLOCK_HEADER_SIZE, total};
+        if (block.raw_size == 0 || block.raw_size > BLOCK_SIZE || block.stored_size == 0 || block.stored_size > block.raw_size) {
+            throw std::invalid_argument("File is corrupt: " + where + " has an invalid header at file byte "
+                + std::to_string(pos) + ".");
+        }
+        if (data.size() - block.input < block.stored_size) {
+            throw std::invalid_argument("File is truncated: " + where + " is incomplete.");
+        }
+        pos = block.input + block.stored_size;
+        total += block.raw_size;
+        blocks.push_back(block);
+    }
+    if (pos != data.size()) {
+        throw std::invalid_argument("File is corrupt: unexpected data after the last block.");
+    }
+
+    // Decompress and validate the blocks in parallel, straight into the output
+    std::string out(total, '\0');
+    enum Failure : char { NONE, MALFORMED, CHECKSUM };
+    std::vector<Failure> failed(count, NONE);
+    std::atomic<std::size_t> next(0);
+    auto work = [&]() {
+        for (std::size_t b = next++; b < count; b = next++) {
+            const Block& block = blocks[b];
+            const char* input = data.data() + block.input;
+            char* output = &out[0] + block.output;
+            if (block.stored_size == block.raw_size) {
+                std::memcpy(output, input, block.raw_size);
+            } else if (!decompress(input, block.stored_size, output, block.raw_size)) {
+                failed[b] = MALFORMED;
+                continue;
+            }
+            if (crc32(output, block.raw_size) != block.crc) {
+                failed[b] = CHECKSUM;
+            }
+        }
+    };
+    std::size_t thread_count = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < thread_count; ++t) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t b = 0; b < count; ++b) {
+        if (failed[b] != NONE) {
+            // Both ranges are inclusive: the block's stored bytes in the file and
+            // the bytes of the serialized tree it decompresses to
+            throw std::invalid_argument("File is corrupt: block " + std::to_string(b + 1) + " of "
+                + std::to_string(count) + " (file bytes " + std::to_string(blocks[b].input) + "-"
+                + std::to_string(blocks[b].input + blocks[b].stored_size - 1) + ", payload bytes "
+                + std::to_string(blocks[b].output) + "-" + std::to_string(blocks[b].output + blocks[b].raw_size - 1) + ") "
+                + (failed[b] == MALFORMED ? "cannot be decompressed." : "failed its checksum."));
+        }
+    }
+    return out;
+}
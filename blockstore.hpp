@@ -0,0 +1,39 @@
+#ifndef BLOCKSTORE_HPP
+#define BLOCKSTORE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+// Block-structured container for serialized family trees. The payload is split
+// into blocks of at most BLOCK_SIZE bytes, each compressed independently and
+// carrying a CRC-32 of its uncompressed contents.
+namespace blockstore {
+    constexpr std::size_t BLOCK_SIZE = 1 << 16;
+
+    // Writes a container to a file one block at a time. The payload size must
+    // be known up front because the header records the block count.
+    class Encoder {
+        public:
+            Encoder(FILE* file, std::size_t payload_size);
+            Encoder(const Encoder&) = delete;
+            Encoder& operator=(const Encoder&) = delete;
+
+            void write(const char* data, std::size_t size);
+            // Flushes the last block; false if the payload size was not met
+            [[nodiscard]] bool finish();
+        private:
+            FILE* file;
+            std::size_t remaining;
+            std::string block;
+            std::string compressed;
+            std::vector<int> table;
+
+            void flush_block();
+    };
+
+    [[nodiscard]] bool is_container(const std::string& data);
+    [[nodiscard]] std::string decode(const std::string& data);
+}
+
+#endif  // defined(BLOCKSTORE_HPP)
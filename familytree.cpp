@@ -1,7 +1,26 @@
 #include "familytree.hpp"
+#include "blockstore.hpp"
 #include <stdexcept>
 #include <cstdio>
+#include <cstring>
 #include <limits>
+#include <algorithm>
+#include <optional>
+
+static std::string read_file(const std::string& filename) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        throw std::invalid_argument("The specified file does not exist.");
+    }
+    std::string data;
+    char buffer[1 << 16];
+    std::size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.append(buffer, count);
+    }
+    fclose(file);
+    return data;
+}
 
 void FamilyTree::get_ancestors(int id, std::unordered_map<int, int>& distances, int depth) const {
     if (this->members.at(id).member.father) {
@@ -69,9 +88,13 @@ std::string FamilyTree::get_relationship(int subject, int object) const {
     if (min_ancestor == 0) {
         throw std::runtime_error("No common ancestor exists.");
     }
-    int min = std::min(subject_ancestors.at(min_ancestor), object_ancestors.at(min_ancestor));
-    int diff = std::abs(object_ancestors.at(min_ancestor) - subject_ancestors.at(min_ancestor));
-    bool obj_lower = object_ancestors.at(min_ancestor) > subject_ancestors.at(min_ancestor);
+    return this->describe_relationship(subject, object, subject_ancestors.at(min_ancestor), object_ancestors.at(min_ancestor));
+}
+
+std::string FamilyTree::describe_relationship(int subject, int object, int subject_distance, int object_distance) const {
+    int min = std::min(subject_distance, object_distance);
+    int diff = std::abs(object_distance - subject_distance);
+    bool obj_lower = object_distance > subject_distance;
     std::string result;
     if (min == 0) {
         if (diff == 0) {
@@ -166,6 +189,176 @@ std::string FamilyTree::get_relationship(int subject, int object) const {
     return result;
 }
 
+void FamilyTree::RelationshipScratch::Walk::start(int id) {
+    for (int reached_id : this->reached) {
+        this->head[reached_id] = -1;
+    }
+    for (int queued_id : this->frontier) {
+        this->pending[queued_id] = 0;
+        this->queued[queued_id] = 0;
+    }
+    this->reached.clear();
+    this->entries.clear();
+    this->frontier.clear();
+    this->grow(id);
+    this->frontier.push_back(id);
+    this->pending[id] = 1;
+    this->queued[id] = 1;
+}
+
+void FamilyTree::RelationshipScratch::Walk::grow(int id) {
+    if (static_cast<std::size_t>(id) >= this->head.size()) {
+        std::size_t size = std::max<std::size_t>(id + 1, 2 * this->head.size());
+        this->head.resize(size, -1);
+        this->pending.resize(size, 0);
+        this->queued.resize(size, 0);
+    }
+}
+
+bool FamilyTree::RelationshipScratch::Walk::seen(int id) const {
+    return static_cast<std::size_t>(id) < this->head.size() && this->head[id] >= 0;
+}
+
+int FamilyTree::RelationshipScratch::Walk::min_depth(int id) const {
+    int depth = std::numeric_limits<int>::max();
+    for (int e = this->head[id]; e >= 0; e = this->entries[e].next) {
+        depth = std::min(depth, this->entries[e].depth);
+    }
+    return depth;
+}
+
+void FamilyTree::advance_walk(RelationshipScratch::Walk& walk, const RelationshipScratch::Walk& other, int depth, int max_depth) const {
+    // Record one generation of the walk, carrying the number of distinct paths
+    // to each ancestor so that collapsed pedigrees stay linear. Members already
+    // reached by the other walk are common ancestors; nothing above them can be
+    // a minimal one, so they are not expanded.
+    walk.layer.clear();
+    for (int id : walk.frontier) {
+        walk.layer.push_back({id, walk.pending[id]});
+        walk.pending[id] = 0;
+        walk.queued[id] = 0;
+    }
+    walk.frontier.clear();
+    for (auto [id, count] : walk.layer) {
+        if (walk.head[id] < 0) {
+            walk.reached.push_back(id);
+        }
+        walk.entries.push_back({depth, count, walk.head[id]});
+        walk.head[id] = walk.entries.size() - 1;
+        if (depth == max_depth || other.seen(id)) {
+            continue;
+        }
+        const Member& m = this->members.at(id).member;
+        for (int parent : {m.father, m.mother}) {
+            if (parent) {
+                walk.grow(parent);
+                if (!walk.queued[parent]) {
+                    walk.queued[parent] = 1;
+                    walk.frontier.push_back(parent);
+                }
+                unsigned long long& total = walk.pending[parent];
+                total = (count > std::numeric_limits<unsigned long long>::max() - total)
+                    ? std::numeric_limits<unsigned long long>::max() : total + count;
+            }
+        }
+    }
+}
+
+std::vector<FamilyTree::Relationship> FamilyTree::get_relationships(int subject, int object, int max_depth) const {
+    RelationshipScratch scratch;
+    return this->get_relationships(subject, object, scratch, max_depth);
+}
+
+std::vector<FamilyTree::Relationship> FamilyTree::get_relationships(int subject, int object, RelationshipScratch& scratch, int max_depth) const {
+    if (!this->member_exists(subject) || !this->member_exists(object)) {
+        throw std::invalid_argument("One of the given IDs does not exist.");
+    }
+    if (max_depth < 0) {
+        throw std::invalid_argument("The depth limit must not be negative.");
+    }
+    // No acyclic path is longer than this; it also bounds walks trapped in a cycle
+    max_depth = std::min<std::size_t>(max_depth, this->members.size() - 1);
+
+    // Walk both ancestries a generation at a time; each side stops where it meets the other
+    RelationshipScratch::Walk& subject_walk = scratch.subject;
+    RelationshipScratch::Walk& object_walk = scratch.object;
+    subject_walk.start(subject);
+    object_walk.start(object);
+    for (int depth = 0; depth <= max_depth && (!subject_walk.frontier.empty() || !object_walk.frontier.empty()); ++depth) {
+        this->advance_walk(subject_walk, object_walk, depth, max_depth);
+        this->advance_walk(object_walk, subject_walk, depth, max_depth);
+    }
+
+    // A candidate is not minimal if one of its children is a common ancestor
+    // within the depth limit. The walks stopped at the candidates, so climb from
+    // each of them rather than relying on what the walks recorded. hops holds the
+    // generations left in the window (-1 for a parent just outside it, -2 if
+    // not reached by the climb).
+    for (int id : scratch.climbed) {
+        scratch.hops[id] = -2;
+    }
+    scratch.climbed.clear();
+    scratch.stack.clear();
+    for (int id : object_walk.reached) {
+        if (subject_walk.seen(id)) {
+            int remaining = max_depth - std::max(subject_walk.min_depth(id), object_walk.min_depth(id));
+            scratch.stack.push_back({id, remaining});
+        }
+    }
+    while (!scratch.stack.empty()) {
+        auto [id, remaining] = scratch.stack.back();
+        scratch.stack.pop_back();
+        const Member& m = this->members.at(id).member;
+        for (int parent : {m.father, m.mother}) {
+            if (!parent) {
+                continue;
+            }
+            if (static_cast<std::size_t>(parent) >= scratch.hops.size()) {
+                scratch.hops.resize(std::max<std::size_t>(parent + 1, 2 * scratch.hops.size()), -2);
+            }
+            if (scratch.hops[parent] < remaining - 1) {
+                if (scratch.hops[parent] == -2) {
+                    scratch.climbed.push_back(parent);
+                }
+                scratch.hops[parent] = remaining - 1;
+                if (remaining > 0) {
+                    scratch.stack.push_back({parent, remaining - 1});
+                }
+            }
+        }
+    }
+
+    std::vector<Relationship> v;
+    for (int ancestor : object_walk.reached) {
+        if (!subject_walk.seen(ancestor)
+            || (static_cast<std::size_t>(ancestor) < scratch.hops.size() && scratch.hops[ancestor] != -2)) {
+            continue;
+        }
+        for (int s = subject_walk.head[ancestor]; s >= 0; s = subject_walk.entries[s].next) {
+            for (int o = object_walk.head[ancestor]; o >= 0; o = object_walk.entries[o].next) {
+                const RelationshipScratch::Entry& se = subject_walk.entries[s];
+                const RelationshipScratch::Entry& oe = object_walk.entries[o];
+                unsigned long long paths = (oe.count > std::numeric_limits<unsigned long long>::max() / se.count)
+                    ? std::numeric_limits<unsigned long long>::max() : se.count * oe.count;
+                v.push_back({ancestor, se.depth, oe.depth, paths,
+                    this->describe_relationship(subject, object, se.depth, oe.depth)});
+            }
+        }
+    }
+    std::sort(v.begin(), v.end(), [](const Relationship& a, const Relationship& b) {
+        int a_total = a.subject_distance + a.object_distance;
+        int b_total = b.subject_distance + b.object_distance;
+        if (a_total != b_total) {
+            return a_total < b_total;
+        }
+        if (a.ancestor != b.ancestor) {
+            return a.ancestor < b.ancestor;
+        }
+        return a.subject_distance < b.subject_distance;
+    });
+    return v;
+}
+
 std::vector<std::pair<int, FamilyTree::Member>> FamilyTree::list_members() const {
     std::vector<std::pair<int, FamilyTree::Member>> v;
     std::priority_queue<int, std::vector<int>, std::greater<int>> order_pq;
@@ -179,100 +372,446 @@ std::vector<std::pair<int, FamilyTree::Member>> FamilyTree::list_members() const
     return v;
 }
 
-void FamilyTree::store_to_file(std::string filename) const {
-    // Topologically sort the members
+std::vector<int> FamilyTree::topological_order(const std::unordered_set<int>* subset) const {
+    // Kahn's algorithm: founders first, each child after both of its parents.
+    // Members on or below a cycle are left out.
+    auto in_subset = [subset](int id) {
+        return id && (!subset || subset->find(id) != subset->end());
+    };
     std::unordered_map<int, int> indegrees;
     std::queue<int> q;
-    for (auto [key, value] : this->members) {
+    auto count_parents = [&](int key) {
+        const Member& m = this->members.at(key).member;
         indegrees[key] = 0;
-        if (value.member.father) {
+        if (in_subset(m.father)) {
             ++indegrees[key];
         }
-        if (value.member.mother) {
+        if (in_subset(m.mother)) {
             ++indegrees[key];
         }
         if (indegrees[key] == 0) {
             q.push(key);
         }
+    };
+    // A subset is visited on its own so that its cost does not depend on the tree size
+    if (subset) {
+        for (int key : *subset) {
+            count_parents(key);
+        }
+    } else {
+        for (const auto& entry : this->members) {
+            count_parents(entry.first);
+        }
     }
     std::vector<int> v;
-    std::unordered_map<int, int> map;
     while (!q.empty()) {
         int id = q.front();
         q.pop();
-        map[id] = v.size() + 1;
         v.push_back(id);
         for (auto child : this->members.at(id).children) {
-            --indegrees[child];
-            if (indegrees[child] == 0) {
-                q.push(child);
+            if (in_subset(child)) {
+                --indegrees[child];
+                if (indegrees[child] == 0) {
+                    q.push(child);
+                }
+            }
+        }
+    }
+    return v;
+}
+
+std::unordered_map<int, int> FamilyTree::assign_generations(const std::unordered_set<int>* subset) const {
+    // Longest path from a founder, relaxed in topological order
+    std::unordered_map<int, int> generations;
+    for (int id : this->topological_order(subset)) {
+        const Member& m = this->members.at(id).member;
+        int generation = 0;
+        for (int parent : {m.father, m.mother}) {
+            auto found = generations.find(parent);
+            if (found != generations.end()) {
+                generation = std::max(generation, found->second + 1);
+            }
+        }
+        generations[id] = generation;
+    }
+    if (generations.size() < (subset ? subset->size() : this->members.size())) {
+        int missing = std::numeric_limits<int>::max();
+        auto check = [&](int key) {
+            if (generations.find(key) == generations.end()) {
+                missing = std::min(missing, key);
+            }
+        };
+        if (subset) {
+            for (int key : *subset) {
+                check(key);
+            }
+        } else {
+            for (const auto& entry : this->members) {
+                check(entry.first);
+            }
+        }
+        throw std::runtime_error("The family tree contains a cycle: member " + std::to_string(missing)
+            + " is its own ancestor or descends from one who is.");
+    }
+    return generations;
+}
+
+std::vector<std::vector<int>> FamilyTree::order_layers(const std::unordered_map<int, int>& generations) const {
+    std::vector<std::vector<int>> layers;
+    for (auto [id, generation] : generations) {
+        if (layers.size() <= static_cast<std::size_t>(generation)) {
+            layers.resize(generation + 1);
+        }
+        layers[generation].push_back(id);
+    }
+
+    // Relative position of each member within its layer, in [0, 1]
+    std::unordered_map<int, double> positions;
+    auto place = [&positions](std::vector<int>& layer) {
+        for (std::size_t i = 0; i < layer.size(); ++i) {
+            positions[layer[i]] = (i + 0.5) / layer.size();
+        }
+    };
+    auto reorder = [&positions, &place](std::vector<int>& layer, const std::unordered_map<int, double>& keys) {
+        std::stable_sort(layer.begin(), layer.end(), [&keys](int a, int b) {
+            return keys.at(a) < keys.at(b);
+        });
+        place(layer);
+    };
+    for (std::vector<int>& layer : layers) {
+        std::sort(layer.begin(), layer.end());
+        place(layer);
+    }
+    std::vector<std::vector<int>> best = layers;
+    long long best_crossings = this->count_crossings(layers);
+    auto keep_if_better = [&]() {
+        long long crossings = this->count_crossings(layers);
+        if (crossings < best_crossings) {
+            best = layers;
+            best_crossings = crossings;
+        }
+    };
+
+    // Barycentre heuristic: alternately sort each layer by the mean position of
+    // its members' parents (downward sweep) and children (upward sweep). Only
+    // relatives that are themselves being laid out count. A sweep can make
+    // things worse, so the ordering with the fewest crossings seen is kept.
+    std::unordered_map<int, double> keys;
+    for (int sweep = 0; sweep < 4 && best_crossings > 0; ++sweep) {
+        for (std::size_t g = 1; g < layers.size(); ++g) {
+            keys.clear();
+            for (int id : layers[g]) {
+                const Member& m = this->members.at(id).member;
+                double sum = 0;
+                int count = 0;
+                for (int parent : {m.father, m.mother}) {
+                    auto found = positions.find(parent);
+                    if (found != positions.end()) {
+                        sum += found->second;
+                        ++count;
+                    }
+                }
+                keys[id] = count ? sum / count : positions.at(id);
+            }
+            reorder(layers[g], keys);
+        }
+        keep_if_better();
+        for (std::size_t g = layers.size(); g-- > 0;) {
+            keys.clear();
+            for (int id : layers[g]) {
+                double sum = 0;
+                int count = 0;
+                for (int child : this->members.at(id).children) {
+                    auto found = positions.find(child);
+                    if (found != positions.end()) {
+                        sum += found->second;
+                        ++count;
+                    }
+                }
+                keys[id] = count ? sum / count : positions.at(id);
+            }
+            reorder(layers[g], keys);
+        }
+        keep_if_better();
+    }
+    return best;
+}
+
+long long FamilyTree::count_crossings(const std::vector<std::vector<int>>& layers) const {
+    // Crossings between adjacent layers: with the edges sorted by the parent's
+    // position, an edge crosses every earlier edge whose child lies further right
+    std::unordered_map<int, std::pair<std::size_t, int>> index;
+    for (std::size_t g = 0; g < layers.size(); ++g) {
+        for (std::size_t i = 0; i < layers[g].size(); ++i) {
+            index[layers[g][i]] = {g, i};
+        }
+    }
+    long long crossings = 0;
+    std::vector<std::pair<int, int>> edges;
+    std::vector<int> tree;
+    for (std::size_t g = 1; g < layers.size(); ++g) {
+        edges.clear();
+        for (std::size_t i = 0; i < layers[g].size(); ++i) {
+            const Member& m = this->members.at(layers[g][i]).member;
+            for (int parent : {m.father, m.mother}) {
+                auto found = index.find(parent);
+                if (found != index.end() && found->second.first == g - 1) {
+                    edges.push_back({found->second.second, static_cast<int>(i)});
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        // Fenwick tree over child positions
+        tree.assign(layers[g].size() + 1, 0);
+        for (std::size_t e = 0; e < edges.size(); ++e) {
+            int not_right = 0;
+            for (int k = edges[e].second + 1; k > 0; k -= k & -k) {
+                not_right += tree[k];
+            }
+            crossings += e - not_right;
+            for (std::size_t k = edges[e].second + 1; k < tree.size(); k += k & -k) {
+                ++tree[k];
             }
         }
     }
+    return crossings;
+}
+
+std::unordered_map<int, int> FamilyTree::get_generations() const {
+    return this->assign_generations(nullptr);
+}
+
+std::vector<std::vector<int>> FamilyTree::get_generation_layers() const {
+    return this->order_layers(this->get_generations());
+}
+
+void FamilyTree::store_to_file(std::string filename, bool compressed) const {
+    std::vector<int> v = this->topological_order();
+    std::unordered_map<int, int> map;
+    for (std::size_t i = 0; i < v.size(); ++i) {
+        map[v[i]] = i + 1;
+    }
     map[0] = 0;
 
-    // Store them in topological order
-    FILE* file = fopen(filename.c_str(), "w");
+    FILE* file = fopen(filename.c_str(), "wb");
     if (!file) {
         throw std::invalid_argument("Invalid file: cannot be opened for writing.");
     }
+
+    // The container needs the payload size up front; plain files are written directly
+    std::optional<blockstore::Encoder> encoder;
+    if (compressed) {
+        std::size_t size = 0;
+        for (int i : v) {
+            size += this->members.at(i).member.name.size() + 1 + 1 + 2 * sizeof(int);
+        }
+        encoder.emplace(file, size);
+    }
+    auto put = [&](const void* data, std::size_t size) {
+        if (encoder) {
+            encoder->write(static_cast<const char*>(data), size);
+        } else {
+            fwrite(data, 1, size, file);
+        }
+    };
+
+    // Store them in topological order
     for (int i : v) {
         const Member& m = this->members.at(i).member;
-        fwrite(m.name.c_str(), 1, m.name.size() + 1, file);
+        put(m.name.c_str(), m.name.size() + 1);
+        char gender = 0;
         switch(m.gender) {
             case MALE:
-                fputc(0, file);
+                gender = 0;
                 break;
             case FEMALE:
-                fputc(1, file);
+                gender = 1;
                 break;
         }
+        put(&gender, 1);
         int parents[2] = {map[m.father], map[m.mother]};
-        fwrite(parents, 4, 2, file);
+        put(parents, sizeof(parents));
     }
+    bool complete = !encoder || encoder->finish();
     fclose(file);
+    if (!complete) {
+        throw std::logic_error("Serialized tree size does not match the container header.");
+    }
 }
 
-void FamilyTree::read_from_file(std::string filename) {
-    FILE* file = fopen(filename.c_str(), "r");
-    if (!file) {
-        throw std::invalid_argument("The specified file does not exist.");
+// Writes a double-quoted string literal. JSON gets \u escapes for control
+// characters; DOT has no such escape, so there they become spaces.
+static void write_quoted(FILE* file, const std::string& s, FamilyTree::ExportFormat format) {
+    fputc('"', file);
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            fputc('\\', file);
+            fputc(c, file);
+        } else if (c < 0x20) {
+            switch (format) {
+                case FamilyTree::GRAPHVIZ:
+                    fputc(' ', file);
+                    break;
+                case FamilyTree::JSON:
+                    fprintf(file, "\\u%04x", c);
+                    break;
+            }
+        } else {
+            fputc(c, file);
+        }
     }
-    while (true) {
-        Member member;
-        // read name
-        char c;
-        while ((c = fgetc(file)) && !feof(file)) {
-            member.name.push_back(c);
+    fputc('"', file);
+}
+
+void FamilyTree::export_to_file(std::string filename, ExportFormat format, int center, int radius) const {
+    if (center && !this->member_exists(center)) {
+        throw std::invalid_argument("The given ID does not match a member of the family tree.");
+    }
+    if (radius < 0) {
+        throw std::invalid_argument("The radius must not be negative.");
+    }
+
+    // Select the members within the given number of parent/child links of the center
+    std::unordered_set<int> selected;
+    if (center) {
+        std::queue<std::pair<int, int>> q;
+        q.push({center, 0});
+        selected.insert(center);
+        while (!q.empty()) {
+            auto [id, distance] = q.front();
+            q.pop();
+            if (distance == radius) {
+                continue;
+            }
+            const MapValue& value = this->members.at(id);
+            for (int parent : {value.member.father, value.member.mother}) {
+                if (parent && selected.insert(parent).second) {
+                    q.push({parent, distance + 1});
+                }
+            }
+            for (int child : value.children) {
+                if (selected.insert(child).second) {
+                    q.push({child, distance + 1});
+                }
+            }
         }
-        if (feof(file)) {
-            if (member.name.empty()) {
-                break;
-            } else {
-                throw std::invalid_argument("File is in invalid format");
+    }
+
+    // A neighbourhood is laid out on its own, so generations count from its
+    // oldest members and each layer is ordered among the exported members only
+    std::unordered_map<int, int> generations = this->assign_generations(center ? &selected : nullptr);
+    std::vector<std::vector<int>> layers = this->order_layers(generations);
+    auto included = [&generations](int id) {
+        return generations.find(id) != generations.end();
+    };
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file) {
+        throw std::invalid_argument("Invalid file: cannot be opened for writing.");
+    }
+    switch (format) {
+        case GRAPHVIZ:
+            fputs("digraph family {\n    node [shape=box];\n", file);
+            for (const std::vector<int>& layer : layers) {
+                fputs("    { rank=same;\n", file);
+                for (int id : layer) {
+                    const Member& m = this->members.at(id).member;
+                    fprintf(file, "        %d [label=", id);
+                    write_quoted(file, m.name, format);
+                    fputs(m.gender == MALE ? "];\n" : ", style=rounded];\n", file);
+                }
+                fputs("    }\n", file);
+            }
+            for (const std::vector<int>& layer : layers) {
+                for (int id : layer) {
+                    const Member& m = this->members.at(id).member;
+                    if (included(m.father)) {
+                        fprintf(file, "    %d -> %d;\n", m.father, id);
+                    }
+                    if (included(m.mother)) {
+                        fprintf(file, "    %d -> %d;\n", m.mother, id);
+                    }
+                }
             }
+            fputs("}\n", file);
+            break;
+        case JSON: {
+            fputs("{\"members\": [", file);
+            bool first = true;
+            for (std::size_t g = 0; g < layers.size(); ++g) {
+                for (std::size_t i = 0; i < layers[g].size(); ++i) {
+                    int id = layers[g][i];
+                    const Member& m = this->members.at(id).member;
+                    fprintf(file, "%s\n    {\"id\": %d, \"name\": ", first ? "" : ",", id);
+                    write_quoted(file, m.name, format);
+                    fprintf(file, ", \"gender\": \"%s\", \"generation\": %zu, \"order\": %zu, \"father\": %d, \"mother\": %d}",
+                        m.gender == MALE ? "M" : "F", g, i,
+                        included(m.father) ? m.father : 0, included(m.mother) ? m.mother : 0);
+                    first = false;
+                }
+            }
+            fputs("\n]}\n", file);
+            break;
         }
+    }
+    fclose(file);
+}
+
+bool FamilyTree::read_from_file(std::string filename) {
+    std::string data = read_file(filename);
+    bool compressed = blockstore::is_container(data);
+    if (compressed) {
+        data = blockstore::decode(data);
+    }
 
-        c = fgetc(file);
-        if (feof(file)) {
-            throw std::invalid_argument("File is in invalid format");
+    // Parse and validate every record before touching the tree. Records refer
+    // to their parents by 1-based position in the file.
+    std::vector<Member> records;
+    auto invalid = [&records](const std::string& problem) {
+        return std::invalid_argument("File is in invalid format: record " + std::to_string(records.size() + 1) + " " + problem);
+    };
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        Member member;
+        std::size_t name_end = data.find('\0', pos);
+        if (name_end == std::string::npos || data.size() - name_end < 10) {
+            throw invalid("is truncated.");
         }
-        switch(c) {
+        member.name = data.substr(pos, name_end - pos);
+        pos = name_end + 1;
+
+        switch(data[pos]) {
             case 0:
                 member.gender = MALE;
                 break;
             case 1:
                 member.gender = FEMALE;
                 break;
+            default:
+                throw invalid("has an invalid gender.");
         }
+        ++pos;
 
-        fread(&member.father, 4, 2, file);
-        if (feof(file)) {
-            throw std::invalid_argument("File is in invalid format");
+        std::memcpy(&member.father, &data[pos], 4);
+        std::memcpy(&member.mother, &data[pos + 4], 4);
+        pos += 8;
+        for (auto [parent, gender] : {std::make_pair(member.father, MALE), std::make_pair(member.mother, FEMALE)}) {
+            if (parent < 0 || static_cast<std::size_t>(parent) > records.size()) {
+                throw invalid("refers to a missing parent.");
+            }
+            if (parent && records[parent - 1].gender != gender) {
+                throw invalid(gender == MALE ? "has a father who is not male." : "has a mother who is not female.");
+            }
         }
+        records.push_back(std::move(member));
+    }
 
-        this->add_member(member.name, member.gender, member.father, member.mother);
+    std::vector<int> ids;
+    for (const Member& record : records) {
+        int father = record.father ? ids[record.father - 1] : 0;
+        int mother = record.mother ? ids[record.mother - 1] : 0;
+        ids.push_back(this->add_member(record.name, record.gender, father, mother));
     }
+    return compressed;
 }
 
 int FamilyTree::add_member(std::string name, Gender gender, int father, int mother) {
@@ -5,18 +5,60 @@
 #include <queue>
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
 class FamilyTree {
     public:
         enum Gender {
             MALE, FEMALE
         };
+        enum ExportFormat {
+            GRAPHVIZ, JSON
+        };
         struct Member {
             std::string name = "";
             Gender gender = MALE;
             int father = 0;
             int mother = 0;
         };
+        struct Relationship {
+            int ancestor = 0;
+            int subject_distance = 0;
+            int object_distance = 0;
+            unsigned long long paths = 0;
+            std::string name = "";
+        };
+
+        // Working storage for get_relationships. The buffers are indexed by member
+        // ID and keep their capacity between queries, so a caller issuing many
+        // queries should hold on to one. Not safe to share between threads.
+        class RelationshipScratch {
+            friend class FamilyTree;
+            struct Entry {
+                int depth = 0;
+                unsigned long long count = 0;
+                int next = -1;
+            };
+            struct Walk {
+                std::vector<int> head = std::vector<int>();
+                std::vector<unsigned long long> pending = std::vector<unsigned long long>();
+                std::vector<char> queued = std::vector<char>();
+                std::vector<Entry> entries = std::vector<Entry>();
+                std::vector<int> reached = std::vector<int>();
+                std::vector<int> frontier = std::vector<int>();
+                std::vector<std::pair<int, unsigned long long>> layer = std::vector<std::pair<int, unsigned long long>>();
+
+                void start(int id);
+                void grow(int id);
+                [[nodiscard]] bool seen(int id) const;
+                [[nodiscard]] int min_depth(int id) const;
+            };
+            Walk subject = Walk();
+            Walk object = Walk();
+            std::vector<int> hops = std::vector<int>();
+            std::vector<int> climbed = std::vector<int>();
+            std::vector<std::pair<int, int>> stack = std::vector<std::pair<int, int>>();
+        };
     private:
         struct MapValue {
             Member member = Member();
@@ -26,6 +68,12 @@ class FamilyTree {
         std::priority_queue<int, std::vector<int>, std::greater<int>> pq;
 
         void get_ancestors(int id, std::unordered_map<int, int>& distances, int depth = 0) const;
+        std::string describe_relationship(int subject, int object, int subject_distance, int object_distance) const;
+        void advance_walk(RelationshipScratch::Walk& walk, const RelationshipScratch::Walk& other, int depth, int max_depth) const;
+        std::vector<int> topological_order(const std::unordered_set<int>* subset = nullptr) const;
+        std::unordered_map<int, int> assign_generations(const std::unordered_set<int>* subset) const;
+        std::vector<std::vector<int>> order_layers(const std::unordered_map<int, int>& generations) const;
+        long long count_crossings(const std::vector<std::vector<int>>& layers) const;
     public:
         FamilyTree();
 
@@ -34,11 +82,16 @@ class FamilyTree {
         [[nodiscard]] FamilyTree::Member get_member(int id) const;
         [[nodiscard]] const std::unordered_set<int>& get_children(int id) const;
         [[nodiscard]] std::string get_relationship(int subject, int object) const;
+        [[nodiscard]] std::vector<FamilyTree::Relationship> get_relationships(int subject, int object, int max_depth = 16) const;
+        [[nodiscard]] std::vector<FamilyTree::Relationship> get_relationships(int subject, int object, RelationshipScratch& scratch, int max_depth = 16) const;
         [[nodiscard]] std::vector<std::pair<int, FamilyTree::Member>> list_members() const;
+        [[nodiscard]] std::unordered_map<int, int> get_generations() const;
+        [[nodiscard]] std::vector<std::vector<int>> get_generation_layers() const;
 
-        void store_to_file(std::string filename) const;
+        void store_to_file(std::string filename, bool compressed = false) const;
+        void export_to_file(std::string filename, ExportFormat format, int center = 0, int radius = 0) const;
 
-        void read_from_file(std::string filename);
+        bool read_from_file(std::string filename);
         int add_member(std::string name, Gender gender, int father = 0, int mother = 0);
         void set_name(int id, std::string name);
         void connect_parent(int child, int parent);
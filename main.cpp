@@ -2,19 +2,22 @@
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <sstream>
 
 int main(int argc, char* argv[]) {
     bool changes_made = false;
     std::string overall_filename;
+    bool overall_compressed = false;
 
     if (argc > 2) {
         std::cerr << "Usage: " << argv[0] << " [filename]" << std::endl;
         return EXIT_FAILURE;
     }
     FamilyTree ft;
+    FamilyTree::RelationshipScratch scratch;
     if (argc == 2) {
         try {
-            ft.read_from_file(argv[1]);
+            overall_compressed = ft.read_from_file(argv[1]);
         } catch (const std::exception& err) {
             std::cerr << err.what() << std::endl;
             return 1;
@@ -221,17 +224,86 @@ int main(int argc, char* argv[]) {
             } catch (const std::exception& err) {
                 std::cerr << err.what() << std::endl;
             }
+        } else if (cmd == "get_relationships") {
+            int subject, object;
+            std::cin >> subject >> object;
+            if (!std::cin.good()) {
+                std::cin.clear();
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                std::cerr << "Invalid ID." << std::endl;
+                continue;
+            }
+            std::string remainder;
+            getline(std::cin, remainder);
+            get_remainder = false;
+            int max_depth = 16;
+            std::istringstream depth_stream(remainder);
+            if (!(depth_stream >> std::ws).eof() && (!(depth_stream >> max_depth) || !(depth_stream >> std::ws).eof())) {
+                std::cerr << "Invalid depth limit." << std::endl;
+                continue;
+            }
+            try {
+                std::vector<FamilyTree::Relationship> relationships = ft.get_relationships(subject, object, scratch, max_depth);
+                if (relationships.empty()) {
+                    std::cout << "No common ancestor exists within " << max_depth << " generations." << std::endl;
+                }
+                for (const FamilyTree::Relationship& r : relationships) {
+                    std::cout << ft.get_member(object).name << " is the " << r.name << " of " << ft.get_member(subject).name
+                        << " through " << ft.get_member(r.ancestor).name << " (" << r.ancestor << ")";
+                    if (r.paths > 1) {
+                        std::cout << " [" << r.paths << " paths]";
+                    }
+                    std::cout << "." << std::endl;
+                }
+            } catch (const std::exception& err) {
+                std::cerr << err.what() << std::endl;
+            }
+        } else if (cmd == "list_generations") {
+            try {
+                std::vector<std::vector<int>> layers = ft.get_generation_layers();
+                for (std::size_t g = 0; g < layers.size(); ++g) {
+                    std::cout << "Generation " << g << ":" << std::endl;
+                    for (int id : layers[g]) {
+                        std::cout << std::setw(10) << id << " ... " << ft.get_member(id).name << std::endl;
+                    }
+                }
+            } catch (const std::exception& err) {
+                std::cerr << err.what() << std::endl;
+            }
+        } else if (cmd == "export_graphviz" || cmd == "export_json") {
+            int center, radius;
+            std::cin >> center >> radius;
+            if (!std::cin.good()) {
+                std::cin.clear();
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                std::cerr << "Invalid ID or radius." << std::endl;
+                continue;
+            }
+            while (isspace(std::cin.peek())) {
+                std::cin.get();
+            }
+            std::string filename;
+            getline(std::cin, filename);
+            get_remainder = false;
+            try {
+                ft.export_to_file(filename, cmd == "export_graphviz" ? FamilyTree::ExportFormat::GRAPHVIZ : FamilyTree::ExportFormat::JSON, center, radius);
+                std::cerr << "Exported to \"" << filename << "\"." << std::endl;
+            } catch (const std::exception& err) {
+                std::cerr << err.what() << std::endl;
+            }
         } else if (cmd == "read_from_file") {
             while (isspace(std::cin.peek())) {
                 std::cin.get();
             }
             std::string filename;
             getline(std::cin, filename);
+            get_remainder = false;
 
             if (changes_made) {
                 std::cout << "You have made changes. Are you sure you want to discard them? (y/N) >> " << std::flush;
                 char choice;
                 std::cin >> choice;
+                get_remainder = true;
                 if (choice != 'Y' && choice != 'y') {
                     std::cerr << "Cancelling..." << std::endl;
                     continue;
@@ -239,21 +311,23 @@ int main(int argc, char* argv[]) {
             }
 
             try {
-                ft.read_from_file(filename);
+                overall_compressed = ft.read_from_file(filename);
                 changes_made = false;
                 overall_filename = filename;
             } catch (const std::exception& err) {
                 std::cerr << err.what() << std::endl;
             }
-        } else if (cmd == "store_to_file") {
+        } else if (cmd == "store_to_file" || cmd == "store_compressed") {
             while (isspace(std::cin.peek())) {
                 std::cin.get();
             }
             std::string filename;
             getline(std::cin, filename);
+            get_remainder = false;
             try {
-                ft.store_to_file(filename);
+                ft.store_to_file(filename, cmd == "store_compressed");
                 overall_filename = filename;
+                overall_compressed = cmd == "store_compressed";
                 changes_made = false;
             } catch (const std::exception& err) {
                 std::cerr << err.what() << std::endl;
@@ -264,7 +338,7 @@ int main(int argc, char* argv[]) {
                 continue;
             }
             try {
-                ft.store_to_file(overall_filename);
+                ft.store_to_file(overall_filename, overall_compressed);
                 changes_made = false;
             } catch (const std::exception& err) {
                 std::cerr << err.what() << std::endl;